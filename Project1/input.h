@@ -0,0 +1,163 @@
+﻿#ifndef INPUT_H
+#define INPUT_H
+
+#include <GL/glew.h>
+#include <SFML/Window.hpp>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <algorithm>
+
+using InputClock = std::chrono::steady_clock;
+
+// Нажатие или отпускание клавиши. SFML не передаёт время события,
+// поэтому отметка ставится в момент выборки из очереди окна
+struct KeyEvent {
+	sf::Keyboard::Key key;
+	bool pressed;
+	InputClock::time_point time;
+};
+
+// Задержка от события ввода до момента, когда GPU выполнил кадр, в котором оно учтено
+struct LatencySample {
+	sf::Keyboard::Key key;
+	double ms;
+};
+
+// Защита от повторного срабатывания по реальному времени, а не по числу кадров
+struct Cooldown {
+	InputClock::duration duration;
+	InputClock::time_point ready_at;
+
+	explicit Cooldown(InputClock::duration duration) : duration(duration) {}
+
+	bool try_trigger(InputClock::time_point time) {
+		if (time < ready_at)
+			return false;
+		ready_at = time + duration;
+		return true;
+	}
+};
+
+class Input {
+	std::vector<KeyEvent> queue;
+	// События, учтённые в текущем кадре: по ним считается задержка после показа
+	std::vector<KeyEvent> consumed;
+	// Отправленные кадры, которые GPU ещё не выполнил, с событиями, учтёнными в каждом
+	struct PendingFrame {
+		GLsync fence;
+		std::vector<KeyEvent> events;
+	};
+	std::deque<PendingFrame> pending;
+	bool held[sf::Keyboard::KeyCount] = {};
+
+public:
+	// Вызывается для каждого учтённого события после показа кадра
+	std::function<void(const LatencySample&)> on_latency;
+
+	// Возвращает true, если событие относится к клавиатуре и поставлено в очередь
+	bool push(const sf::Event& event) {
+		const InputClock::time_point now = InputClock::now();
+		if (event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased) {
+			if (event.key.code < 0 || event.key.code >= sf::Keyboard::KeyCount)
+				return false;
+			queue.push_back({ event.key.code, event.type == sf::Event::KeyPressed, now });
+			return true;
+		}
+		// Отпускания без фокуса не придут, поэтому отпускаем всё сами
+		if (event.type == sf::Event::LostFocus) {
+			for (int key = 0; key < sf::Keyboard::KeyCount; ++key) {
+				if (held[key])
+					queue.push_back({ (sf::Keyboard::Key)key, false, now });
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// Передаёт накопленные события обработчику в порядке поступления
+	template <typename Handler>
+	void process(Handler handler) {
+		for (const KeyEvent& event : queue) {
+			held[event.key] = event.pressed;
+			handler(event);
+			consumed.push_back(event);
+		}
+		queue.clear();
+	}
+
+	bool is_held(sf::Keyboard::Key key) const {
+		return held[key];
+	}
+
+	// Вызывается сразу после window.display(): ставит в очередь GPU метку, по которой
+	// poll_presented() узнает, что кадр выполнен. Не блокирует, поэтому замер одинаков
+	// с vsync и без него
+	void frame_submitted() {
+		if (consumed.empty())
+			return;
+		pending.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(consumed) });
+		consumed.clear();
+	}
+
+	// Отдаёт замеры для кадров, которые GPU уже выполнил. Вызывается несколько раз за кадр:
+	// задержка отсчитывается до момента проверки, а не до срабатывания метки
+	void poll_presented() {
+		while (!pending.empty()) {
+			GLenum status = glClientWaitSync(pending.front().fence, 0, 0);
+			if (status == GL_TIMEOUT_EXPIRED)
+				break;
+			const InputClock::time_point now = InputClock::now();
+			// GL_WAIT_FAILED: метку не проверить, кадр выбрасываем без замеров
+			if (on_latency && status != GL_WAIT_FAILED) {
+				for (const KeyEvent& event : pending.front().events)
+					on_latency({ event.key, std::chrono::duration<double, std::milli>(now - event.time).count() });
+			}
+			glDeleteSync(pending.front().fence);
+			pending.pop_front();
+		}
+	}
+
+	// Удаляет метки невыполненных кадров, пока контекст ещё жив
+	void release() {
+		for (PendingFrame& frame : pending)
+			glDeleteSync(frame.fence);
+		pending.clear();
+	}
+};
+
+// Средняя и максимальная задержка за последнюю секунду. Старые замеры выбрасываются
+// в update(), который вызывается каждый кадр, а не только при новом событии
+struct LatencyStats {
+	InputClock::duration interval = std::chrono::seconds(1);
+	int count = 0;
+	double avg_ms = 0.0;
+	double max_ms = 0.0;
+
+	void add(const LatencySample& sample) {
+		samples.push_back({ InputClock::now(), sample.ms });
+		update(samples.back().time);
+	}
+
+	void update(InputClock::time_point now) {
+		while (!samples.empty() && now - samples.front().time > interval)
+			samples.pop_front();
+		count = (int)samples.size();
+		avg_ms = max_ms = 0.0;
+		for (const Sample& sample : samples) {
+			avg_ms += sample.ms;
+			max_ms = std::max(max_ms, sample.ms);
+		}
+		if (count)
+			avg_ms /= count;
+	}
+
+private:
+	struct Sample {
+		InputClock::time_point time;
+		double ms;
+	};
+	std::deque<Sample> samples;
+};
+#endif
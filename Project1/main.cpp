@@ -1,4 +1,5 @@
 ﻿#include <cmath>
+#include <cstdio>
 #include <SFML/Window.hpp>
 #include <SFML/Graphics.hpp>
 #include <GL/glew.h>
@@ -6,8 +7,11 @@
 #include <iostream>
 #include <random>
 #include <set>
+#include <thread>
 #include "model.h"
 #include "shader.h"
+#include "occlusion.h"
+#include "input.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
@@ -32,6 +36,16 @@ Model airship_model;
 Model present_model;
 Model target_model;
 
+TextureArray textures;
+
+OccluderMesh tree_occluder;
+OccluderMesh floor_occluder;
+OccluderMesh airship_occluder;
+OccluderMesh target_occluder;
+
+OcclusionCuller occlusion;
+bool occlusion_enabled = true;
+
 struct Camera {
 	glm::vec3 cameraPos;
 	glm::vec3 cameraFront;
@@ -183,11 +197,41 @@ void InitScene() {
 }
 
 void InitModels() {
-	tree_model = Model(tree_model_path, tree_texture_path);
-	floor_model = Model(floor_model_path, floor_texture_path);
-	airship_model = Model(airship_model_path, airship_texture_path);
-	present_model = Model(present_model_path, present_texture_path);
-	target_model = Model(target_model_path, target_texture_path);
+	tree_model.load(tree_model_path, tree_texture_path, textures);
+	floor_model.load(floor_model_path, floor_texture_path, textures);
+	airship_model.load(airship_model_path, airship_texture_path, textures);
+	present_model.load(present_model_path, present_texture_path, textures);
+	target_model.load(target_model_path, target_texture_path, textures);
+	textures.build();
+}
+
+// Окклюдеры строятся по габаритам моделей с запасом внутрь, чтобы не перекрывать лишнего
+void InitOccluders() {
+	// tree.obj и airship.obj в репозитории нет: пропорции ёлки и дирижабля подобраны на глаз
+	// под ожидаемую форму (конус и вытянутый корпус) и взяты с запасом
+	const ModelData& tree = tree_model.data;
+	// Ёлка стоит вдоль локальной оси Z (в сцене повёрнута на 90 градусов)
+	tree_occluder = make_pyramid_occluder(tree.bounds_min, tree.bounds_max, 2, 0.1f, 0.8f, 0.25f);
+
+	const ModelData& floor = floor_model.data;
+	floor_occluder = make_quad_occluder(floor.bounds_min, floor.bounds_max, floor.bounds_max.y, 8);
+
+	const ModelData& airship = airship_model.data;
+	glm::vec3 airship_center = (airship.bounds_min + airship.bounds_max) * 0.5f;
+	glm::vec3 airship_half = (airship.bounds_max - airship.bounds_min) * 0.2f;
+	airship_occluder = make_box_occluder(airship_center - airship_half, airship_center + airship_half);
+
+	// У снеговика берём брусок внутри нижнего шара: по высоте 0.12..0.38, по ширине 0.15
+	// габаритов (ширину раздувают руки). Проверено сечениями треугольников data/snowman.obj:
+	// брусок целиком внутри и при 0.17 по ширине или 0.10..0.40 по высоте
+	const ModelData& target = target_model.data;
+	glm::vec3 target_size = target.bounds_max - target.bounds_min;
+	glm::vec3 target_center = (target.bounds_min + target.bounds_max) * 0.5f;
+	glm::vec3 target_min = target_center - target_size * 0.15f;
+	glm::vec3 target_max = target_center + target_size * 0.15f;
+	target_min.y = target.bounds_min.y + target_size.y * 0.12f;
+	target_max.y = target.bounds_min.y + target_size.y * 0.38f;
+	target_occluder = make_box_occluder(target_min, target_max);
 }
 
 void Init() {
@@ -196,6 +240,7 @@ void Init() {
 	glEnable(GL_DEPTH_TEST);
 	glClearColor(0.5, 0.5, 0.5, 0.0);
 	InitModels();
+	InitOccluders();
 }
 
 float angleX = 0.0f;
@@ -212,11 +257,6 @@ void DrawModel(const Model& object, const glm::mat4& model, GLuint Program) {
 
 void Draw() {
 	glUseProgram(Program); // Устанавливаем шейдерную программу текущей
-	glm::vec3 front;
-	front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-	front.y = sin(glm::radians(pitch));
-	front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-	free_camera.cameraFront = glm::normalize(front);
 
 	static float time = 0;
 	time += 0.1f;
@@ -247,7 +287,9 @@ void Draw() {
 	glUniform4fv(glGetUniformLocation(Program, "light.specular"), 1, glm::value_ptr(light.specular));
 
 
-	glUniform1i(glGetUniformLocation(Program, "material.texture"), 0);
+	// Все текстуры в одном массиве: одна привязка на кадр
+	textures.bind(GL_TEXTURE0);
+	glUniform1i(glGetUniformLocation(Program, "textures"), 0);
 	glUniform4f(glGetUniformLocation(Program, "material.ambient"), 1.0f, 1.0f, 1.0f, 1.0f);
 	glUniform4f(glGetUniformLocation(Program, "material.diffuse"), 1.0f, 1.0f, 1.0f, 1.0f);
 	glUniform4f(glGetUniformLocation(Program, "material.specular"), 1.0f, 1.0f, 1.0f, 1.0f);
@@ -255,19 +297,44 @@ void Draw() {
 	glUniform1f(glGetUniformLocation(Program, "material.shininess"), 32.0f);
 
 
+	glm::mat4 tree_transform = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
+	tree_transform = glm::scale(tree_transform, glm::vec3(0.01f, 0.01f, 0.01f));
+	glm::mat4 floor_transform = glm::scale(glm::mat4(1.0f), glm::vec3(10.0f, 10.0f, 10.0f));
+	glm::mat4 airship_transform = glm::translate(glm::mat4(1.0f), airship_position);
+	airship_transform = glm::rotate(airship_transform, glm::radians(airship_dir ? 180.0f : 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	airship_transform = glm::scale(airship_transform, glm::vec3(.3f, .3f, .3f));
+	std::vector<glm::mat4> target_transforms;
+	target_transforms.reserve(targets.size());
+	for (auto& target : targets) {
+		model = glm::translate(glm::mat4(1.0f), target);
+		target_transforms.push_back(glm::scale(model, glm::vec3(0.1f, 0.1f, 0.1f)));
+	}
+
+	// Программное отсечение перекрытых объектов
+	if (occlusion_enabled) {
+		occlusion.begin_frame(projection * view);
+		occlusion.add_occluder(tree_occluder, tree_transform);
+		occlusion.add_occluder(floor_occluder, floor_transform);
+		occlusion.add_occluder(airship_occluder, airship_transform);
+		for (const glm::mat4& transform : target_transforms)
+			occlusion.add_occluder(target_occluder, transform);
+		occlusion.rasterize();
+	}
+	auto is_visible = [](const Model& object, const glm::mat4& transform) {
+		return !occlusion_enabled || occlusion.is_visible(object.data.bounds_min, object.data.bounds_max, transform);
+	};
+
 	// XMAS TREE
 	glUniform1i(glGetUniformLocation(Program, "applyWave"), 1);
-	model = glm::mat4(1.0f);
-	model = glm::rotate(model, glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
-	DrawModel(tree_model, model, Program);
+	DrawModel(tree_model, tree_transform, Program);
 	glUniform1i(glGetUniformLocation(Program, "applyWave"), 0);
 
 	// PRESENT
 	if (present_exists) {
 		model = glm::translate(glm::mat4(1.0f), present_position);
 		model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
-		DrawModel(present_model, model, Program);
+		if (is_visible(present_model, model))
+			DrawModel(present_model, model, Program);
 	}
 	
 	// FLOOR
@@ -279,17 +346,16 @@ void Draw() {
 	}
 
 	// AIRSHIP
-	model = glm::translate(glm::mat4(1.0f), airship_position);
-	model = glm::rotate(model, glm::radians(airship_dir ? 180.0f : 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(.3f, .3f, .3f));
-	DrawModel(airship_model, model, Program);
+	DrawModel(airship_model, airship_transform, Program);
 
 	// TARGETS
-	for (auto& target : targets) {
-		model = glm::translate(glm::mat4(1.0f), target);
-		model = glm::scale(model, glm::vec3(0.1f, 0.1f, 0.1f));
-		DrawModel(target_model, model, Program);
+	for (const glm::mat4& transform : target_transforms) {
+		if (is_visible(target_model, transform))
+			DrawModel(target_model, transform, Program);
 	}
+
+	if (occlusion_enabled)
+		occlusion.end_frame();
 	
 	glUseProgram(0); // Отключаем шейдерную программу
 }
@@ -306,103 +372,274 @@ void ReleaseShader() {
 void Release() {
 	// Шейдеры
 	ReleaseShader();
+	occlusion.release();
 
 	tree_model.release();
 	floor_model.release();
 	airship_model.release();
 	present_model.release();
 	target_model.release();
+	textures.release();
+}
+
+Input input;
+LatencyStats input_latency;
+// Режим низкой задержки: без вертикальной синхронизации, кадр начинается как можно позже
+bool low_latency = false;
+
+// Переключатели срабатывают по нажатию; интервал как прежние 20 кадров при 60 Гц
+const InputClock::duration toggle_cool_down = std::chrono::milliseconds(330);
+
+void DropPresent() {
+	if (present_exists)
+		return;
+	present_exists = true;
+	present_position = airship_position;
+	present_position.y -= 0.2;
+}
+
+void HandleKeyEvent(const KeyEvent& event) {
+	static Cooldown change_camera_cool_down(toggle_cool_down);
+	static Cooldown freeze_cool_down(toggle_cool_down);
+	static Cooldown projector_cool_down(toggle_cool_down);
+	static Cooldown occlusion_cool_down(toggle_cool_down);
+	static Cooldown latency_cool_down(toggle_cool_down);
+
+	if (!event.pressed)
+		return;
+
+	switch (event.key) {
+	case sf::Keyboard::Q:
+		if (change_camera_cool_down.try_trigger(event.time)) {
+			if (camera == &free_camera)
+				camera = &airship_camera;
+			else
+				camera = &free_camera;
+		}
+		break;
+	case sf::Keyboard::Space:
+		DropPresent();
+		break;
+	case sf::Keyboard::Tab:
+		if (freeze_cool_down.try_trigger(event.time))
+			freeze = !freeze;
+		break;
+	case sf::Keyboard::L:
+		if (projector_cool_down.try_trigger(event.time)) {
+			if (projector.spotCosCutoff == cos(glm::radians(20.0f)))
+				projector.spotCosCutoff = cos(glm::radians(0.0f));
+			else
+				projector.spotCosCutoff = cos(glm::radians(20.0f));
+		}
+		break;
+	case sf::Keyboard::O:
+		if (occlusion_cool_down.try_trigger(event.time))
+			occlusion_enabled = !occlusion_enabled;
+		break;
+	case sf::Keyboard::P:
+		if (latency_cool_down.try_trigger(event.time))
+			low_latency = !low_latency;
+		break;
+	default:
+		break;
+	}
 }
 
 void HandleKeyboardInput() {
-	constexpr float cameraSpeed = 0.3f;
+	// Удерживаемый пробел сбрасывает следующий подарок, как только упал предыдущий
+	if (input.is_held(sf::Keyboard::Space))
+		DropPresent();
+}
+
+void UpdateFreeCameraFront() {
+	glm::vec3 front;
+	front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+	front.y = sin(glm::radians(pitch));
+	front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+	free_camera.cameraFront = glm::normalize(front);
+}
+
+// Движение свободной камеры по удерживаемым клавишам за прошедшее реальное время.
+// Вызывается непосредственно перед Draw(), чтобы матрица вида учитывала самый свежий ввод
+void ApplyCameraInput() {
+	// Скорости в секунду: прежние значения за кадр при 60 Гц
+	constexpr float cameraSpeed = 0.3f * 60.0f;
 	float cameraShiftScale = 0.5f;
-	float rotationSpeed = 0.75f;
-	constexpr float lightSpeed = 0.2f;
-	static int change_camera_cool_down = 0;
-	static int freeze_cool_down = 0;
-	static int projector_cool_down = 0;
-
-	if (change_camera_cool_down > 0)
-		--change_camera_cool_down;
-	if (freeze_cool_down > 0)
-		--freeze_cool_down;
-	if (projector_cool_down > 0)
-		--projector_cool_down;
-
-	if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift)) {
+	float rotationSpeed = 0.75f * 60.0f;
+	static InputClock::time_point last_time = InputClock::now();
+
+	const InputClock::time_point now = InputClock::now();
+	// Ограничиваем шаг, чтобы после долгой паузы камера не улетала
+	const float dt = std::min(std::chrono::duration<float>(now - last_time).count(), 0.1f);
+	last_time = now;
+
+	if (input.is_held(sf::Keyboard::LShift)) {
 		cameraShiftScale *= 2;
 		rotationSpeed *= 2;
 	}
 
-	if (sf::Keyboard::isKeyPressed(sf::Keyboard::Q) && !change_camera_cool_down) {
-		change_camera_cool_down = 20;
-		if (camera == &free_camera)
-			camera = &airship_camera;
-		else
-			camera = &free_camera;
-	}
-
-	if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space) && !present_exists) {
-		present_exists = true;
-		present_position = airship_position;
-		present_position.y -= 0.2;
+	if (camera == &free_camera) {
+		if (input.is_held(sf::Keyboard::Up)) pitch += rotationSpeed * dt;
+		if (input.is_held(sf::Keyboard::Down)) pitch -= rotationSpeed * dt;
+		if (input.is_held(sf::Keyboard::Left)) yaw -= rotationSpeed * dt;
+		if (input.is_held(sf::Keyboard::Right)) yaw += rotationSpeed * dt;
+
+		if (pitch > 89.0f) pitch = 89.0f;
+		if (pitch < -89.0f) pitch = -89.0f;
+		UpdateFreeCameraFront();
+
+		const float step = cameraSpeed * cameraShiftScale * dt;
+		const glm::vec3 right = glm::normalize(glm::cross(free_camera.cameraFront, free_camera.cameraUp));
+		if (input.is_held(sf::Keyboard::W)) free_camera.cameraPos += free_camera.cameraFront * step;
+		if (input.is_held(sf::Keyboard::S)) free_camera.cameraPos -= free_camera.cameraFront * step;
+		if (input.is_held(sf::Keyboard::A)) free_camera.cameraPos -= right * step;
+		if (input.is_held(sf::Keyboard::D)) free_camera.cameraPos += right * step;
 	}
+}
 
-	if (sf::Keyboard::isKeyPressed(sf::Keyboard::Tab) && !freeze_cool_down) {
-		freeze = !freeze;
-		freeze_cool_down = 20;
+void PollEvents(sf::Window& window) {
+	sf::Event event;
+	while (window.pollEvent(event)) {
+		if (input.push(event))
+			continue;
+		if (event.type == sf::Event::Closed) { window.close(); }
+		else if (event.type == sf::Event::Resized) { glViewport(0, 0, event.size.width, event.size.height); }
 	}
+	input.process(HandleKeyEvent);
+}
 
-	if (sf::Keyboard::isKeyPressed(sf::Keyboard::L) && !projector_cool_down) {
-		if (projector.spotCosCutoff == cos(glm::radians(20.0f)))
-			projector.spotCosCutoff = cos(glm::radians(0.0f));
-		else
-			projector.spotCosCutoff = cos(glm::radians(20.0f));
+// Ожидание до момента deadline. Sleep() в Windows по умолчанию спит с шагом ~15.6 мс,
+// а sf::sleep на время сна поднимает разрешение таймера до 1 мс; последнюю
+// миллисекунду досиживаем в цикле, чтобы не проспать срок
+void WaitUntil(InputClock::time_point deadline) {
+	const InputClock::duration spin = std::chrono::milliseconds(1);
+	const InputClock::time_point now = InputClock::now();
+	if (deadline - now > spin)
+		sf::sleep(sf::microseconds(std::chrono::duration_cast<std::chrono::microseconds>(deadline - now - spin).count()));
+	while (InputClock::now() < deadline)
+		std::this_thread::yield();
+}
 
-		projector_cool_down = 20;
+// Период обновления дисплея по интервалам между кадрами с vsync. Медиана отбрасывает
+// пропущенные кадры и подвисания
+struct RefreshPeriod {
+	static constexpr size_t SAMPLES = 31;
+	std::vector<InputClock::duration> intervals;
+	size_t next = 0;
+	InputClock::time_point last_present;
+
+	void frame_presented(InputClock::time_point now) {
+		if (last_present != InputClock::time_point()) {
+			if (intervals.size() < SAMPLES)
+				intervals.push_back(now - last_present);
+			else
+				intervals[next++ % SAMPLES] = now - last_present;
+		}
+		last_present = now;
 	}
 
-	if (camera == &free_camera) {
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) free_camera.cameraPos += cameraSpeed * free_camera.cameraFront * cameraShiftScale;
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::S)) free_camera.cameraPos -= cameraSpeed * free_camera.cameraFront * cameraShiftScale;
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) free_camera.cameraPos -= glm::normalize(glm::cross(free_camera.cameraFront, free_camera.cameraUp)) * cameraSpeed * cameraShiftScale;
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) free_camera.cameraPos += glm::normalize(glm::cross(free_camera.cameraFront, free_camera.cameraUp)) * cameraSpeed * cameraShiftScale;
-	
-
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up)) pitch += rotationSpeed;
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down)) pitch -= rotationSpeed;
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) yaw -= rotationSpeed;
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) yaw += rotationSpeed;
+	// Без измерений считаем, что дисплей 60 Гц
+	InputClock::duration get() const {
+		if (intervals.size() < 8)
+			return std::chrono::microseconds(16667);
+		std::vector<InputClock::duration> sorted = intervals;
+		std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+		return sorted[sorted.size() / 2];
 	}
 
-	if (pitch > 89.0f) pitch = 89.0f;
-	if (pitch < -89.0f) pitch = -89.0f;
-}
+	void reset() { last_present = InputClock::time_point(); }
+};
 
 int main() {
 	sf::Window window(sf::VideoMode(900, 900), "My OpenGL window", sf::Style::Default, sf::ContextSettings(24));
 	window.setVerticalSyncEnabled(true);
+	// Повторы нажатий не нужны: удержание отслеживается по событиям
+	window.setKeyRepeatEnabled(false);
 	window.setActive(true);
 	glewInit();
 	Init();
 	InitScene();
+	UpdateFreeCameraFront();
+
+	input.on_latency = [](const LatencySample& sample) { input_latency.add(sample); };
+
+	// В режиме низкой задержки держим частоту дисплея, измеренную при vsync, чтобы не менялись
+	// ни плавность, ни скорость игры (Update() продвигает её на шаг за кадр)
+	RefreshPeriod refresh_period;
+	InputClock::duration frame_period = refresh_period.get();
+	// Сглаженная длительность отрисовки и показа кадра
+	double render_ms = 2.0;
+	bool vsync = true;
+	InputClock::time_point next_frame = InputClock::now();
 
 	while (window.isOpen()) {
-		sf::Event event;
-		while (window.pollEvent(event)) {
-			if (event.type == sf::Event::Closed) { window.close(); }
-			else if (event.type == sf::Event::Resized) { glViewport(0, 0, event.size.width, event.size.height); }
+		PollEvents(window);
+		if (!window.isOpen())
+			break;
+		input.poll_presented();
+		HandleKeyboardInput();
+		Update();
+
+		if (low_latency == vsync) {
+			vsync = !low_latency;
+			if (!vsync)
+				frame_period = refresh_period.get();
+			refresh_period.reset();
+			window.setVerticalSyncEnabled(vsync);
+			next_frame = InputClock::now();
+		}
+		if (low_latency) {
+			// Ждём до последнего момента, когда кадр ещё успевает к сроку, и опрашиваем ввод заново
+			next_frame = std::max(next_frame + frame_period, InputClock::now());
+			WaitUntil(next_frame - std::chrono::microseconds((long long)(render_ms * 1000.0))
+				- std::chrono::milliseconds(1));
+			input.poll_presented();
+			PollEvents(window);
+			if (!window.isOpen())
+				break;
+			HandleKeyboardInput();
 		}
+
+		// Поздняя фиксация камеры: последний опрос ввода прямо перед отрисовкой
+		ApplyCameraInput();
+		const InputClock::time_point render_start = InputClock::now();
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		sf::Vector2u windowSize = window.getSize();
 		aspectRatio = static_cast<float>(windowSize.x) / static_cast<float>(windowSize.y);
-		HandleKeyboardInput();
-		Update();
 		Draw();
-		window.setTitle("kill count " + std::to_string(kill_count));
+		std::string title = "kill count " + std::to_string(kill_count);
+		if (occlusion_enabled) {
+			char cull_ms[16];
+			snprintf(cull_ms, sizeof(cull_ms), "%.3f", occlusion.cull_ms);
+			title += " | occluded " + std::to_string(occlusion.occluded_count) + "/" +
+				std::to_string(occlusion.tested_count) + " | culling " + cull_ms + " ms";
+		}
+		char latency[48];
+		if (input_latency.count)
+			snprintf(latency, sizeof(latency), " | input %.1f ms (max %.1f)", input_latency.avg_ms, input_latency.max_ms);
+		else
+			snprintf(latency, sizeof(latency), " | input -");
+		title += latency;
+		if (low_latency)
+			title += " low latency";
+		window.setTitle(title);
 		window.display();
+		// Задержка ввода в обоих режимах меряется одинаково: до выполнения кадра на GPU
+		// (включая обмен буферов), без ожидания развёртки на дисплее
+		input.frame_submitted();
+		if (low_latency) {
+			// Без vsync display() лишь отправляет кадр: ждём, пока GPU его выполнит, иначе драйвер
+			// копит кадры впрок, а оценка времени отрисовки учитывает только CPU
+			glFinish();
+			const double frame_ms = std::chrono::duration<double, std::milli>(InputClock::now() - render_start).count();
+			render_ms = render_ms * 0.9 + frame_ms * 0.1;
+		}
+		else
+			refresh_period.frame_presented(InputClock::now());
+		input.poll_presented();
+		input_latency.update(InputClock::now());
 	}
+	input.release();
 	Release();
 	return 0;
-}
\ No newline at end of file
+}
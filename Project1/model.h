@@ -1,4 +1,4 @@
-#ifndef MODEL_H
+﻿#ifndef MODEL_H
 #define MODEL_H
 
 #include <SFML/Window.hpp>
@@ -6,6 +6,9 @@
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -21,23 +24,191 @@ struct Vertex {
 		position(glm::vec3(pos_x, pos_y, pos_z)) {}
 };
 
-struct Texture {
-	GLuint id = -1;
-	sf::Texture texture;
+// Владеющая обёртка над GL-объектом: только перемещение, удаление в деструкторе
+template <typename Deleter>
+class GLHandle {
+	GLuint id = 0;
+
+public:
+	GLHandle() = default;
+	explicit GLHandle(GLuint id) : id(id) {}
+	GLHandle(const GLHandle&) = delete;
+	GLHandle& operator=(const GLHandle&) = delete;
+	GLHandle(GLHandle&& other) noexcept : id(other.id) { other.id = 0; }
+	GLHandle& operator=(GLHandle&& other) noexcept {
+		if (this != &other) {
+			reset();
+			id = other.id;
+			other.id = 0;
+		}
+		return *this;
+	}
+	~GLHandle() { reset(); }
+
+	GLuint get() const { return id; }
+	explicit operator bool() const { return id != 0; }
+
+	void reset() {
+		if (id) {
+			Deleter()(id);
+			id = 0;
+		}
+	}
+};
+
+struct BufferDeleter {
+	void operator()(GLuint id) const { glDeleteBuffers(1, &id); }
+};
+
+struct VertexArrayDeleter {
+	void operator()(GLuint id) const { glDeleteVertexArrays(1, &id); }
+};
+
+using GLBuffer = GLHandle<BufferDeleter>;
+using GLVertexArray = GLHandle<VertexArrayDeleter>;
+
+inline GLBuffer make_buffer() {
+	GLuint id;
+	glGenBuffers(1, &id);
+	return GLBuffer(id);
+}
+
+inline GLVertexArray make_vertex_array() {
+	GLuint id;
+	glGenVertexArrays(1, &id);
+	return GLVertexArray(id);
+}
+
+struct TextureDeleter {
+	void operator()(GLuint id) const { glDeleteTextures(1, &id); }
+};
+
+using GLTexture = GLHandle<TextureDeleter>;
+
+inline GLTexture make_texture() {
+	GLuint id;
+	glGenTextures(1, &id);
+	return GLTexture(id);
+}
+
+// Положение текстуры внутри общего массива: слой и прямоугольник (смещение, размер) в UV
+struct TextureLayer {
+	int layer = -1;
+	glm::vec4 uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+};
+
+// Все текстуры сцены упаковываются в один GL_TEXTURE_2D_ARRAY: размер слоя равен самой
+// большой картинке, меньшие раскладываются по слоям полками. Массив привязывается один раз
+// за кадр, а модели передают в шейдер только номер слоя и UV-прямоугольник.
+// Цена — неиспользуемое место в слоях: при 1024x1024 от airship.png четыре текстуры 200x200
+// занимают целый слой, и массив весит 8 МБ против ~4.6 МБ у отдельных текстур.
+class TextureArray {
+	struct Entry {
+		std::string path;
+		sf::Image image;
+		TextureLayer layer;
+	};
+
+	// deque не перемещает элементы, поэтому указатели из add() остаются валидными
+	std::deque<Entry> entries;
+	GLTexture texture;
+
+public:
+	// Загружает картинку; метаданные слоя заполняются в build()
+	const TextureLayer* add(const std::string& path) {
+		for (const Entry& entry : entries) {
+			if (entry.path == path)
+				return &entry.layer;
+		}
+		entries.emplace_back();
+		Entry& entry = entries.back();
+		if (!entry.image.loadFromFile(path)) {
+			std::cerr << "Failed to load texture: " << path << std::endl;
+			entries.pop_back();
+			return nullptr;
+		}
+		entry.path = path;
+		return &entry.layer;
+	}
+
+	void build() {
+		if (entries.empty())
+			return;
+		unsigned width = 0, height = 0;
+		std::vector<Entry*> order;
+		for (Entry& entry : entries) {
+			width = std::max(width, entry.image.getSize().x);
+			height = std::max(height, entry.image.getSize().y);
+			order.push_back(&entry);
+		}
+		std::sort(order.begin(), order.end(), [](const Entry* a, const Entry* b) {
+			return a->image.getSize().y > b->image.getSize().y;
+		});
+
+		// Раскладка полками: слева направо, затем новая полка, затем новый слой
+		std::vector<sf::Vector2u> offsets(order.size());
+		unsigned x = 0, y = 0, shelf_height = 0;
+		int layer = 0;
+		for (size_t i = 0; i < order.size(); ++i) {
+			sf::Vector2u size = order[i]->image.getSize();
+			if (x + size.x > width) {
+				x = 0;
+				y += shelf_height;
+				shelf_height = 0;
+			}
+			if (y + size.y > height) {
+				x = y = shelf_height = 0;
+				++layer;
+			}
+			offsets[i] = sf::Vector2u(x, y);
+			order[i]->layer.layer = layer;
+			order[i]->layer.uv_rect = glm::vec4((float)x / width, (float)y / height,
+				(float)size.x / width, (float)size.y / height);
+			x += size.x;
+			shelf_height = std::max(shelf_height, size.y);
+		}
+
+		texture = make_texture();
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture.get());
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layer + 1, 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		for (size_t i = 0; i < order.size(); ++i) {
+			sf::Vector2u size = order[i]->image.getSize();
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, offsets[i].x, offsets[i].y, order[i]->layer.layer,
+				size.x, size.y, 1, GL_RGBA, GL_UNSIGNED_BYTE, order[i]->image.getPixelsPtr());
+			// Картинка уже в видеопамяти, create(0, 0) освобождает пиксели
+			order[i]->image.create(0, 0);
+		}
+		// Повторение делается в шейдере внутри UV-прямоугольника, поэтому фильтрация без
+		// смешивания соседей, как у sf::Texture по умолчанию
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+
+	void bind(GLenum unit) const {
+		glActiveTexture(unit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture.get());
+	}
+
+	void release() {
+		texture.reset();
+	}
 };
 
 class Mesh {
 	void setup_mesh() {
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
-		//glGenBuffers(1, &instanceVBO);
+		VAO = make_vertex_array();
+		VBO = make_buffer();
+		EBO = make_buffer();
 
-		glBindVertexArray(VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+		glBindVertexArray(VAO.get());
+		glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
@@ -47,59 +218,38 @@ class Mesh {
 		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tex_coords));
 
 		glBindVertexArray(0);
-	}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	void setup_texture(const std::string& text_path) {
-		sf::Texture tex;
-		tex.loadFromFile(text_path);
-		tex.setRepeated(true);
-		texture = { 0, tex };
+		// После загрузки в видеопамять CPU-копия больше не нужна
+		index_count = (GLsizei)indices.size();
+		std::vector<Vertex>().swap(vertices);
+		std::vector<GLuint>().swap(indices);
 	}
 
 	void release() {
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glDeleteBuffers(1, &VBO);
-		glDeleteBuffers(1, &EBO);
-		//glDeleteBuffers(1, &instanceVBO);
-		glDeleteVertexArrays(1, &VAO);
+		EBO.reset();
+		VBO.reset();
+		VAO.reset();
 	}
 
 public:
 	std::vector<Vertex> vertices;
 	std::vector<GLuint> indices;
-	Texture texture;
-	GLuint VAO, VBO, EBO, instanceVBO;
+	GLsizei index_count = 0;
+	GLVertexArray VAO;
+	GLBuffer VBO, EBO;
 
 	Mesh() = default;
+	Mesh(Mesh&&) = default;
+	Mesh& operator=(Mesh&&) = default;
 
-	friend class ModelData;
-	friend class Model;
+	friend struct ModelData;
+	friend struct Model;
 
-	void display_mesh(GLuint shader_id) const {
-		if (texture.id != -1) {
-			glActiveTexture(GL_TEXTURE0);
-			glUniform1i(glGetUniformLocation(shader_id, "material.texture"), 0);
-			sf::Texture::bind(&texture.texture);
-		}
-		glBindVertexArray(VAO);
-
-		//CalculateOrbitTransform(orbit_transform);
-		//glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-		//glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * NUM_PLANETS, orbit_transform, GL_STATIC_DRAW);
-		//
-		//for (int i = 0; i < 4; i++) {
-		//	glEnableVertexAttribArray(3 + i);
-		//	glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * i));
-		//	glVertexAttribDivisor(3 + i, 1);
-		//}
-
-		//glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		//glDrawElementsInstanced(GL_TRIANGLES, (GLuint)indices.size(), GL_UNSIGNED_INT, 0, NUM_PLANETS);
-		glDrawElements(GL_TRIANGLES, (GLuint)indices.size(), GL_UNSIGNED_INT, 0);
+	void display_mesh() const {
+		glBindVertexArray(VAO.get());
+		glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, 0);
 		glBindVertexArray(0);
-		if (texture.id != -1)
-			sf::Texture::bind(NULL);
 	}
 };
 
@@ -117,6 +267,10 @@ std::vector<std::string> split(const std::string& str, char sep = ' ') {
 
 struct ModelData {
 	std::vector<Mesh> meshes;
+	const TextureLayer* texture = nullptr;
+	// Ограничивающий параллелепипед в локальных координатах модели
+	glm::vec3 bounds_min = glm::vec3(0.0f);
+	glm::vec3 bounds_max = glm::vec3(0.0f);
 
 	Vertex process_vertex(const std::string& vert, const std::vector<glm::vec3>& vert_positions,
 		const std::vector<glm::vec3>& vert_normals, const std::vector<glm::vec2>& vert_tex_coords) {
@@ -150,19 +304,81 @@ struct ModelData {
 		return res_vert;
 	}
 
-	void load_model(const std::string& file_name, const std::string& tex_path) {
+	// Предварительный проход: сколько элементов каждого типа и сколько вершин в каждом меше
+	struct ObjCounts {
+		size_t positions = 0, normals = 0, tex_coords = 0;
+		std::vector<size_t> mesh_vertices;
+	};
+
+	static ObjCounts count_elements(std::istream& file) {
+		ObjCounts counts;
+		bool is_new_mesh = false;
+		std::string line;
+		while (std::getline(file, line)) {
+			size_t start = line.find_first_not_of(" \t");
+			if (start == std::string::npos)
+				continue;
+			size_t end = line.find_first_of(" \t", start);
+			if (end == std::string::npos)
+				end = line.size();
+			const size_t type_len = end - start;
+			const char* type = line.c_str() + start;
+			if (type_len == 1 && type[0] == 'v') {
+				is_new_mesh = false;
+				++counts.positions;
+			}
+			else if (type_len == 2 && type[0] == 'v' && type[1] == 'n')
+				++counts.normals;
+			else if (type_len == 2 && type[0] == 'v' && type[1] == 't')
+				++counts.tex_coords;
+			else if (type_len == 1 && type[0] == 'f') {
+				if (!is_new_mesh) {
+					is_new_mesh = true;
+					counts.mesh_vertices.push_back(0);
+				}
+				size_t corners = 0;
+				for (size_t pos = line.find_first_not_of(" \t\r", end); pos != std::string::npos;
+					pos = line.find_first_not_of(" \t\r", line.find_first_of(" \t\r", pos)))
+					++corners;
+				if (corners >= 3)
+					counts.mesh_vertices.back() += 3 * (corners - 2);
+			}
+		}
+		return counts;
+	}
+
+	void load_model(const std::string& file_name) {
 		std::ifstream file(file_name);
 		if (!file.is_open()) {
 			std::cerr << "Failed to open file: " << file_name << std::endl;
 			return;
 		}
 
-		bool is_new_mesh = false;
+		const ObjCounts counts = count_elements(file);
+		file.clear();
+		file.seekg(0);
 		std::vector<glm::vec3> vert_positions;
 		std::vector<glm::vec3> vert_normals;
 		std::vector<glm::vec2> vert_tex_coords;
-		std::vector<GLuint> indices;
-		Mesh cur_mesh;
+		vert_positions.reserve(counts.positions);
+		vert_normals.reserve(counts.normals);
+		vert_tex_coords.reserve(counts.tex_coords);
+		meshes.reserve(meshes.size() + std::max<size_t>(counts.mesh_vertices.size(), 1));
+
+		bool is_new_mesh = false;
+		size_t mesh_ind = 0;
+		auto begin_mesh = [&]() -> Mesh& {
+			meshes.emplace_back();
+			Mesh& mesh = meshes.back();
+			if (mesh_ind < counts.mesh_vertices.size()) {
+				mesh.vertices.reserve(counts.mesh_vertices[mesh_ind]);
+				mesh.indices.reserve(counts.mesh_vertices[mesh_ind]);
+			}
+			++mesh_ind;
+			return mesh;
+		};
+		const size_t first_mesh = meshes.size();
+		Mesh* cur_mesh = &begin_mesh();
 		std::string line;
 
 		while (std::getline(file, line)) {
@@ -174,10 +390,7 @@ struct ModelData {
 			}
 			if (type == "v") {
 				if (is_new_mesh) {
-					cur_mesh.indices = indices;
-					meshes.push_back(cur_mesh);
-					cur_mesh = Mesh();
-					indices.clear();
+					cur_mesh = &begin_mesh();
 					is_new_mesh = false;
 				}
 				float x, y, z;
@@ -198,14 +411,16 @@ struct ModelData {
 				if (!is_new_mesh)
 					is_new_mesh = true;
 				auto spl = split(line);
+				std::vector<Vertex>& vertices = cur_mesh->vertices;
+				std::vector<GLuint>& indices = cur_mesh->indices;
 				for (int i = 3; i < spl.size(); ++i) {
-					cur_mesh.vertices.push_back(process_vertex(spl[1], vert_positions,
+					vertices.push_back(process_vertex(spl[1], vert_positions,
 						vert_normals, vert_tex_coords));
 					indices.push_back(indices.size());
-					cur_mesh.vertices.push_back(process_vertex(spl[i - 1], vert_positions,
+					vertices.push_back(process_vertex(spl[i - 1], vert_positions,
 						vert_normals, vert_tex_coords));
 					indices.push_back(indices.size());
-					cur_mesh.vertices.push_back(process_vertex(spl[i], vert_positions,
+					vertices.push_back(process_vertex(spl[i], vert_positions,
 						vert_normals, vert_tex_coords));
 					indices.push_back(indices.size());
 				}
@@ -213,18 +428,22 @@ struct ModelData {
 		}
 		file.close();
 
-		cur_mesh.indices = indices;
-		meshes.push_back(cur_mesh);
-		for (Mesh& mesh : meshes) {
-			mesh.setup_mesh();
-			if (!tex_path.empty())
-				mesh.setup_texture(tex_path);
+		if (!vert_positions.empty()) {
+			bounds_min = bounds_max = vert_positions[0];
+			for (const glm::vec3& pos : vert_positions) {
+				bounds_min = glm::min(bounds_min, pos);
+				bounds_max = glm::max(bounds_max, pos);
+			}
 		}
+
+		for (size_t i = first_mesh; i < meshes.size(); ++i)
+			meshes[i].setup_mesh();
 	}
 
 	void release() {
 		for (Mesh& mesh : meshes)
 			mesh.release();
+		texture = nullptr;
 	}
 };
 
@@ -232,19 +451,33 @@ struct Model {
 	ModelData data;
 
 	Model() = default;
+	Model(Model&&) = default;
+	Model& operator=(Model&&) = default;
+
+	Model(std::string const& file_path, std::string const& tex_path, TextureArray& textures) {
+		load(file_path, tex_path, textures);
+	}
 
-	Model(std::string const& file_path, std::string const& tex_path) {
-		data.load_model(file_path, tex_path);
+	void load(std::string const& file_path, std::string const& tex_path, TextureArray& textures) {
+		data.load_model(file_path);
+		if (!tex_path.empty())
+			data.texture = textures.add(tex_path);
 	}
 
+	// Массив текстур должен быть уже привязан, здесь задаётся только слой
 	void display_model(GLuint shader_id) const {
+		const TextureLayer no_texture;
+		const TextureLayer& layer = data.texture ? *data.texture : no_texture;
+		glUniform1i(glGetUniformLocation(shader_id, "material.layer"), layer.layer);
+		glUniform4f(glGetUniformLocation(shader_id, "material.uvRect"),
+			layer.uv_rect.x, layer.uv_rect.y, layer.uv_rect.z, layer.uv_rect.w);
 		for (const Mesh& mesh : data.meshes)
-			mesh.display_mesh(shader_id);
+			mesh.display_mesh();
 	}
 
+	// Освобождает GPU-ресурсы заранее, пока GL-контекст ещё жив
 	void release() {
-		for (Mesh& mesh : data.meshes)
-			mesh.release();
+		data.release();
 	}
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,357 @@
+﻿#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <GL/glew.h>
+#include <emmintrin.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include "glm/glm.hpp"
+
+// Упрощённая геометрия окклюдера в локальных координатах модели.
+// Должна целиком лежать внутри настоящей модели, иначе видимые объекты будут отброшены.
+struct OccluderMesh {
+	std::vector<glm::vec3> vertices;
+	std::vector<GLuint> indices;
+};
+
+// Параллелепипед внутри [mn, mx]
+OccluderMesh make_box_occluder(const glm::vec3& mn, const glm::vec3& mx) {
+	OccluderMesh mesh;
+	for (int i = 0; i < 8; ++i)
+		mesh.vertices.emplace_back(i & 1 ? mx.x : mn.x, i & 2 ? mx.y : mn.y, i & 4 ? mx.z : mn.z);
+	mesh.indices = {
+		0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+		0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+		0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5,
+	};
+	return mesh;
+}
+
+// Горизонтальная плоскость на высоте y, разбитая на сетку: треугольники за ближней
+// плоскостью отбрасываются целиком, поэтому большой пол лучше резать на части
+OccluderMesh make_quad_occluder(const glm::vec3& mn, const glm::vec3& mx, float y, int divisions) {
+	OccluderMesh mesh;
+	for (int i = 0; i <= divisions; ++i) {
+		for (int j = 0; j <= divisions; ++j) {
+			mesh.vertices.emplace_back(mn.x + (mx.x - mn.x) * i / divisions, y,
+				mn.z + (mx.z - mn.z) * j / divisions);
+		}
+	}
+	for (int i = 0; i < divisions; ++i) {
+		for (int j = 0; j < divisions; ++j) {
+			GLuint v = i * (divisions + 1) + j;
+			mesh.indices.insert(mesh.indices.end(),
+				{ v, v + 1, v + divisions + 1, v + 1, v + divisions + 2, v + divisions + 1 });
+		}
+	}
+	return mesh;
+}
+
+// Четырёхгранная пирамида вдоль оси up_axis: основание на высоте base, вершина на apex
+// (доли от высоты модели), полуширина основания — доля half_width от полуширины модели
+OccluderMesh make_pyramid_occluder(const glm::vec3& mn, const glm::vec3& mx, int up_axis,
+	float base, float apex, float half_width) {
+	int u = (up_axis + 1) % 3, v = (up_axis + 2) % 3;
+	glm::vec3 center = (mn + mx) * 0.5f;
+	float height = mx[up_axis] - mn[up_axis];
+
+	OccluderMesh mesh;
+	for (int i = 0; i < 4; ++i) {
+		glm::vec3 corner = center;
+		corner[up_axis] = mn[up_axis] + height * base;
+		corner[u] += (i & 1 ? 1.0f : -1.0f) * (mx[u] - mn[u]) * 0.5f * half_width;
+		corner[v] += (i & 2 ? 1.0f : -1.0f) * (mx[v] - mn[v]) * 0.5f * half_width;
+		mesh.vertices.push_back(corner);
+	}
+	glm::vec3 top = center;
+	top[up_axis] = mn[up_axis] + height * apex;
+	mesh.vertices.push_back(top);
+	mesh.indices = { 0, 1, 2, 1, 3, 2,  0, 1, 4, 1, 3, 4,  3, 2, 4, 2, 0, 4 };
+	return mesh;
+}
+
+// Программное отсечение перекрытых объектов: окклюдеры растеризуются в буфер глубины
+// низкого разрешения (SSE2, по 4 пикселя), буфер обрабатывается тайлами в нескольких потоках,
+// затем ограничивающие параллелепипеды кандидатов проверяются по иерархическому Z
+class OcclusionCuller {
+public:
+	static constexpr int WIDTH = 256;
+	static constexpr int HEIGHT = 256;
+	static constexpr int TILE_SIZE = 32;  // единица работы потока, кратна HIZ_SIZE
+	static constexpr int HIZ_SIZE = 8;    // в ячейке хранится самая дальняя глубина окклюдеров
+	static constexpr int TILES_X = WIDTH / TILE_SIZE;
+	static constexpr int TILES_Y = HEIGHT / TILE_SIZE;
+	static constexpr int HIZ_WIDTH = WIDTH / HIZ_SIZE;
+	static constexpr int HIZ_HEIGHT = HEIGHT / HIZ_SIZE;
+	static constexpr float MIN_W = 1e-3f;
+
+	// Статистика последнего завершённого кадра
+	int occluded_count = 0;
+	int tested_count = 0;
+	float cull_ms = 0.0f;
+
+	OcclusionCuller() : depth(WIDTH * HEIGHT, 1.0f), hiz(HIZ_WIDTH * HIZ_HEIGHT, 1.0f) {}
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+	~OcclusionCuller() { release(); }
+
+	void begin_frame(const glm::mat4& view_projection) {
+		Timer timer(frame_time);
+		frame_time = 0.0;
+		frame_occluded = 0;
+		frame_tested = 0;
+		this->view_projection = view_projection;
+		triangles.clear();
+	}
+
+	void add_occluder(const OccluderMesh& mesh, const glm::mat4& model) {
+		Timer timer(frame_time);
+		const glm::mat4 mvp = view_projection * model;
+		clip.clear();
+		for (const glm::vec3& v : mesh.vertices)
+			clip.push_back(mvp * glm::vec4(v, 1.0f));
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+			setup_triangle(clip[mesh.indices[i]], clip[mesh.indices[i + 1]], clip[mesh.indices[i + 2]]);
+	}
+
+	void rasterize() {
+		Timer timer(frame_time);
+		if (workers.empty() && !stop)
+			start_workers();
+		next_tile = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy_workers = (int)workers.size();
+			++generation;
+		}
+		wake.notify_all();
+		process_tiles();
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return busy_workers == 0; });
+	}
+
+	// true, если объект с ограничивающим параллелепипедом [mn, mx] может быть виден
+	bool is_visible(const glm::vec3& mn, const glm::vec3& mx, const glm::mat4& model) {
+		Timer timer(frame_time);
+		++frame_tested;
+		const glm::mat4 mvp = view_projection * model;
+		float min_x = (float)WIDTH, max_x = 0.0f, min_y = (float)HEIGHT, max_y = 0.0f, min_z = 1.0f;
+		for (int i = 0; i < 8; ++i) {
+			glm::vec4 p = mvp * glm::vec4(i & 1 ? mx.x : mn.x, i & 2 ? mx.y : mn.y, i & 4 ? mx.z : mn.z, 1.0f);
+			// Пересекает ближнюю плоскость — проверять нечего
+			if (p.w < MIN_W)
+				return true;
+			float x = (p.x / p.w * 0.5f + 0.5f) * WIDTH;
+			float y = (p.y / p.w * 0.5f + 0.5f) * HEIGHT;
+			min_x = std::min(min_x, x);
+			max_x = std::max(max_x, x);
+			min_y = std::min(min_y, y);
+			max_y = std::max(max_y, y);
+			min_z = std::min(min_z, p.z / p.w * 0.5f + 0.5f);
+		}
+		// Вне экрана: это забота отсечения по пирамиде видимости
+		if (max_x < 0.0f || min_x >= WIDTH || max_y < 0.0f || min_y >= HEIGHT)
+			return true;
+
+		int x0 = std::max((int)std::floor(min_x) - 1, 0) / HIZ_SIZE;
+		int x1 = std::min((int)std::ceil(max_x) + 1, WIDTH - 1) / HIZ_SIZE;
+		int y0 = std::max((int)std::floor(min_y) - 1, 0) / HIZ_SIZE;
+		int y1 = std::min((int)std::ceil(max_y) + 1, HEIGHT - 1) / HIZ_SIZE;
+		for (int y = y0; y <= y1; ++y) {
+			for (int x = x0; x <= x1; ++x) {
+				if (min_z <= hiz[y * HIZ_WIDTH + x])
+					return true;
+			}
+		}
+		++frame_occluded;
+		return false;
+	}
+
+	void end_frame() {
+		occluded_count = frame_occluded;
+		tested_count = frame_tested;
+		cull_ms = (float)frame_time;
+	}
+
+	// Останавливает рабочие потоки
+	void release() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+		workers.clear();
+	}
+
+private:
+	struct ScreenTriangle {
+		// Рёберные функции и плоскость глубины: value = a * x + b * y + c
+		float edge_a[3], edge_b[3], edge_c[3];
+		float z_a, z_b, z_c;
+		int min_x, max_x, min_y, max_y;
+	};
+
+	// Добавляет затраченное время (в миллисекундах) к счётчику кадра
+	struct Timer {
+		double& total;
+		std::chrono::high_resolution_clock::time_point start;
+		explicit Timer(double& total) : total(total), start(std::chrono::high_resolution_clock::now()) {}
+		~Timer() {
+			total += std::chrono::duration<double, std::milli>(
+				std::chrono::high_resolution_clock::now() - start).count();
+		}
+	};
+
+	std::vector<float> depth;
+	std::vector<float> hiz;
+	std::vector<ScreenTriangle> triangles;
+	std::vector<glm::vec4> clip;
+	glm::mat4 view_projection = glm::mat4(1.0f);
+	double frame_time = 0.0;
+	int frame_occluded = 0;
+	int frame_tested = 0;
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::atomic<int> next_tile{ 0 };
+	unsigned generation = 0;
+	int busy_workers = 0;
+	bool stop = false;
+
+	void setup_triangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2) {
+		// Треугольники, пересекающие ближнюю плоскость, пропускаем: окклюдеров становится
+		// меньше, но отсечение остаётся консервативным
+		if (c0.w < MIN_W || c1.w < MIN_W || c2.w < MIN_W)
+			return;
+		float x[3], y[3], z[3];
+		const glm::vec4* c[3] = { &c0, &c1, &c2 };
+		for (int i = 0; i < 3; ++i) {
+			x[i] = (c[i]->x / c[i]->w * 0.5f + 0.5f) * WIDTH;
+			y[i] = (c[i]->y / c[i]->w * 0.5f + 0.5f) * HEIGHT;
+			z[i] = c[i]->z / c[i]->w * 0.5f + 0.5f;
+		}
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (std::abs(area) < 1e-6f)
+			return;
+		// Окклюдеры двусторонние: приводим обход к одному направлению
+		if (area < 0.0f) {
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+
+		ScreenTriangle tri;
+		tri.min_x = std::max((int)std::floor(std::min({ x[0], x[1], x[2] })), 0);
+		tri.max_x = std::min((int)std::ceil(std::max({ x[0], x[1], x[2] })), WIDTH - 1);
+		tri.min_y = std::max((int)std::floor(std::min({ y[0], y[1], y[2] })), 0);
+		tri.max_y = std::min((int)std::ceil(std::max({ y[0], y[1], y[2] })), HEIGHT - 1);
+		if (tri.min_x > tri.max_x || tri.min_y > tri.max_y)
+			return;
+
+		for (int i = 0; i < 3; ++i) {
+			int j = (i + 1) % 3;
+			tri.edge_a[i] = -(y[j] - y[i]);
+			tri.edge_b[i] = x[j] - x[i];
+			tri.edge_c[i] = -tri.edge_a[i] * x[i] - tri.edge_b[i] * y[i];
+		}
+		tri.z_a = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+		tri.z_b = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+		tri.z_c = z[0] - tri.z_a * x[0] - tri.z_b * y[0];
+		triangles.push_back(tri);
+	}
+
+	void start_workers() {
+		unsigned count = std::thread::hardware_concurrency();
+		count = count > 1 ? std::min(count - 1, 7u) : 0;
+		for (unsigned i = 0; i < count; ++i)
+			workers.emplace_back(&OcclusionCuller::worker_loop, this);
+	}
+
+	void worker_loop() {
+		unsigned seen = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return stop || generation != seen; });
+				if (stop)
+					return;
+				seen = generation;
+			}
+			process_tiles();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy_workers == 0)
+				done.notify_one();
+		}
+	}
+
+	void process_tiles() {
+		for (int tile = next_tile++; tile < TILES_X * TILES_Y; tile = next_tile++)
+			rasterize_tile(tile % TILES_X * TILE_SIZE, tile / TILES_X * TILE_SIZE);
+	}
+
+	void rasterize_tile(int tile_x, int tile_y) {
+		for (int y = tile_y; y < tile_y + TILE_SIZE; ++y)
+			std::fill_n(&depth[y * WIDTH + tile_x], TILE_SIZE, 1.0f);
+
+		const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+		for (const ScreenTriangle& tri : triangles) {
+			int x0 = std::max(tri.min_x, tile_x) & ~3;
+			int x1 = std::min(tri.max_x, tile_x + TILE_SIZE - 1);
+			int y0 = std::max(tri.min_y, tile_y);
+			int y1 = std::min(tri.max_y, tile_y + TILE_SIZE - 1);
+			if (x0 > x1 || y0 > y1)
+				continue;
+
+			__m128 a[3], row[3];
+			for (int i = 0; i < 3; ++i)
+				a[i] = _mm_set1_ps(tri.edge_a[i]);
+			const __m128 za = _mm_set1_ps(tri.z_a);
+			for (int y = y0; y <= y1; ++y) {
+				const float py = y + 0.5f;
+				for (int i = 0; i < 3; ++i)
+					row[i] = _mm_set1_ps(tri.edge_b[i] * py + tri.edge_c[i]);
+				const __m128 zrow = _mm_set1_ps(tri.z_b * py + tri.z_c);
+				float* line = &depth[y * WIDTH];
+				for (int x = x0; x <= x1; x += 4) {
+					const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+					__m128 mask = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a[0], px), row[0]), zero);
+					mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a[1], px), row[1]), zero));
+					mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a[2], px), row[2]), zero));
+					if (_mm_movemask_ps(mask) == 0)
+						continue;
+					const __m128 z = _mm_add_ps(_mm_mul_ps(za, px), zrow);
+					const __m128 old_z = _mm_loadu_ps(line + x);
+					const __m128 new_z = _mm_min_ps(old_z, z);
+					_mm_storeu_ps(line + x, _mm_or_ps(_mm_and_ps(mask, new_z), _mm_andnot_ps(mask, old_z)));
+				}
+			}
+		}
+
+		// Иерархический Z: максимум глубины по каждой ячейке HIZ_SIZE x HIZ_SIZE
+		for (int cy = tile_y; cy < tile_y + TILE_SIZE; cy += HIZ_SIZE) {
+			for (int cx = tile_x; cx < tile_x + TILE_SIZE; cx += HIZ_SIZE) {
+				__m128 max_z = _mm_setzero_ps();
+				for (int y = cy; y < cy + HIZ_SIZE; ++y) {
+					for (int x = cx; x < cx + HIZ_SIZE; x += 4)
+						max_z = _mm_max_ps(max_z, _mm_loadu_ps(&depth[y * WIDTH + x]));
+				}
+				max_z = _mm_max_ps(max_z, _mm_shuffle_ps(max_z, max_z, _MM_SHUFFLE(1, 0, 3, 2)));
+				max_z = _mm_max_ps(max_z, _mm_shuffle_ps(max_z, max_z, _MM_SHUFFLE(2, 3, 0, 1)));
+				hiz[cy / HIZ_SIZE * HIZ_WIDTH + cx / HIZ_SIZE] = _mm_cvtss_f32(max_z);
+			}
+		}
+	}
+};
+#endif
@@ -22,8 +22,12 @@ uniform struct DirLight {
     vec4 specular;
 } light;
 
+// Все текстуры сцены лежат в одном массиве, материал хранит слой и UV-прямоугольник
+uniform sampler2DArray textures;
+
 uniform struct Material {
-    sampler2D texture;
+    int layer;
+    vec4 uvRect;
     vec4 ambient;
     vec4 diffuse;
     vec4 specular;
@@ -83,5 +87,9 @@ void main() {
         color += material.diffuse * light.diffuse * 0.1;
 	
 	
-    color *= texture(material.texture, Vert.texcoord);
+    // Повторение текстуры внутри её прямоугольника в слое
+    if (material.layer >= 0) {
+        vec2 uv = material.uvRect.xy + fract(Vert.texcoord) * material.uvRect.zw;
+        color *= texture(textures, vec3(uv, material.layer));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,162 @@
+// Memory use of the OBJ loader: the current ModelData::load_model against the baseline one
+// (legacy_model.h). Runs on the no-op GL/SFML/glm shim from tests/shim, so GPU uploads and
+// texture decoding are not included — only what the loader itself keeps on the CPU.
+//
+//   load_memory <file.obj>            both loaders in one process: allocation counts, bytes and
+//                                     peak live heap; fails if the current loader is worse or
+//                                     produces different geometry
+//   load_memory <file.obj> legacy     one loader per process, prints its peak RSS
+//   load_memory <file.obj> current
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "model.h"
+
+namespace legacy {
+#include "legacy_model.h"
+}
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Счётчики кучи: каждый блок хранит свой размер в заголовке
+namespace {
+
+struct HeapStats {
+	size_t allocations = 0;
+	size_t bytes = 0;
+	size_t live = 0;
+	size_t peak_live = 0;
+};
+
+HeapStats heap;
+
+constexpr size_t HEADER = 16;
+
+void* counted_alloc(size_t size) {
+	void* block = std::malloc(size + HEADER);
+	if (!block)
+		throw std::bad_alloc();
+	*(size_t*)block = size;
+	++heap.allocations;
+	heap.bytes += size;
+	heap.live += size;
+	heap.peak_live = std::max(heap.peak_live, heap.live);
+	return (char*)block + HEADER;
+}
+
+void counted_free(void* ptr) {
+	if (!ptr)
+		return;
+	void* block = (char*)ptr - HEADER;
+	heap.live -= *(size_t*)block;
+	std::free(block);
+}
+
+size_t peak_rss_kb() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (size_t)usage.ru_maxrss;
+#endif
+}
+
+}
+
+void* operator new(size_t size) { return counted_alloc(size); }
+void* operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void* ptr) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { counted_free(ptr); }
+
+struct LoadResult {
+	HeapStats heap;
+	size_t meshes = 0;
+	size_t indices = 0;
+	size_t retained = 0;  // байт кучи, занятых моделью после загрузки
+};
+
+template <typename Data, typename Load, typename CountIndices>
+LoadResult measure(Load load, CountIndices count_indices) {
+	const HeapStats before = heap;
+	heap.peak_live = heap.live;
+	LoadResult result;
+	{
+		Data data;
+		load(data);
+		result.retained = heap.live - before.live;
+		result.heap.allocations = heap.allocations - before.allocations;
+		result.heap.bytes = heap.bytes - before.bytes;
+		result.heap.peak_live = heap.peak_live - before.live;
+		result.meshes = data.meshes.size();
+		for (const auto& mesh : data.meshes)
+			result.indices += count_indices(mesh);
+	}
+	heap.peak_live = std::max(heap.peak_live, before.peak_live);
+	return result;
+}
+
+LoadResult load_legacy(const std::string& path) {
+	return measure<legacy::ModelData>([&](legacy::ModelData& data) { data.load_model(path, ""); },
+		[](const legacy::Mesh& mesh) { return mesh.indices.size(); });
+}
+
+LoadResult load_current(const std::string& path) {
+	return measure<ModelData>([&](ModelData& data) { data.load_model(path); },
+		[](const Mesh& mesh) { return (size_t)mesh.index_count; });
+}
+
+void print(const char* name, const LoadResult& result) {
+	std::printf("%-8s meshes %3zu  indices %7zu  allocations %8zu  allocated %8zu KB  "
+		"peak heap %6zu KB  retained %6zu KB\n", name, result.meshes, result.indices,
+		result.heap.allocations, result.heap.bytes / 1024, result.heap.peak_live / 1024,
+		result.retained / 1024);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::fprintf(stderr, "usage: %s <file.obj> [legacy|current]\n", argv[0]);
+		return 2;
+	}
+	const std::string path = argv[1];
+
+	if (argc > 2) {
+		const bool legacy_loader = std::strcmp(argv[2], "legacy") == 0;
+		const LoadResult result = legacy_loader ? load_legacy(path) : load_current(path);
+		print(argv[2], result);
+		std::printf("%-8s peak RSS %zu KB\n", argv[2], peak_rss_kb());
+		return result.meshes ? 0 : 1;
+	}
+
+	std::printf("%s\n", path.c_str());
+	const LoadResult old_result = load_legacy(path);
+	const LoadResult new_result = load_current(path);
+	print("legacy", old_result);
+	print("current", new_result);
+
+	int failures = 0;
+	if (old_result.meshes != new_result.meshes || old_result.indices != new_result.indices) {
+		std::printf("FAIL: geometry differs from the baseline loader\n");
+		++failures;
+	}
+	if (new_result.heap.allocations > old_result.heap.allocations) {
+		std::printf("FAIL: more allocations than the baseline loader\n");
+		++failures;
+	}
+	if (new_result.heap.peak_live > old_result.heap.peak_live) {
+		std::printf("FAIL: higher peak heap than the baseline loader\n");
+		++failures;
+	}
+	return failures ? 1 : 0;
+}
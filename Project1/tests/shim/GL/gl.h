@@ -0,0 +1,2 @@
+// Everything the loader needs is declared by the GLEW shim.
+#include "glew.h"
@@ -0,0 +1,62 @@
+// No-op stand-in for GLEW/OpenGL so the loader can run without a GL context.
+// Object names are handed out from a counter; nothing is uploaded anywhere.
+#ifndef SHIM_GLEW_H
+#define SHIM_GLEW_H
+
+#include <cstddef>
+
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef unsigned int GLenum;
+typedef int GLsizei;
+typedef std::ptrdiff_t GLsizeiptr;
+typedef unsigned char GLboolean;
+typedef float GLfloat;
+typedef char GLchar;
+
+#define GL_FALSE 0
+#define GL_FLOAT 0x1406
+#define GL_UNSIGNED_BYTE 0x1401
+#define GL_UNSIGNED_INT 0x1405
+#define GL_TRIANGLES 0x0004
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STATIC_DRAW 0x88E4
+#define GL_TEXTURE0 0x84C0
+#define GL_TEXTURE_2D_ARRAY 0x8C1A
+#define GL_RGBA 0x1908
+#define GL_RGBA8 0x8058
+#define GL_TEXTURE_MIN_FILTER 0x2801
+#define GL_TEXTURE_MAG_FILTER 0x2800
+#define GL_TEXTURE_WRAP_S 0x2802
+#define GL_TEXTURE_WRAP_T 0x2803
+#define GL_NEAREST 0x2600
+#define GL_CLAMP_TO_EDGE 0x812F
+
+inline GLuint shim_next_name() {
+	static GLuint name = 0;
+	return ++name;
+}
+
+inline void glGenBuffers(GLsizei n, GLuint* names) { for (GLsizei i = 0; i < n; ++i) names[i] = shim_next_name(); }
+inline void glGenVertexArrays(GLsizei n, GLuint* names) { for (GLsizei i = 0; i < n; ++i) names[i] = shim_next_name(); }
+inline void glGenTextures(GLsizei n, GLuint* names) { for (GLsizei i = 0; i < n; ++i) names[i] = shim_next_name(); }
+inline void glDeleteBuffers(GLsizei, const GLuint*) {}
+inline void glDeleteVertexArrays(GLsizei, const GLuint*) {}
+inline void glDeleteTextures(GLsizei, const GLuint*) {}
+inline void glBindBuffer(GLenum, GLuint) {}
+inline void glBindVertexArray(GLuint) {}
+inline void glBindTexture(GLenum, GLuint) {}
+inline void glBufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+inline void glEnableVertexAttribArray(GLuint) {}
+inline void glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+inline void glDrawElements(GLenum, GLsizei, GLenum, const void*) {}
+inline void glActiveTexture(GLenum) {}
+inline void glTexImage3D(GLenum, GLint, GLint, GLsizei, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) {}
+inline void glTexSubImage3D(GLenum, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei, GLenum, GLenum, const void*) {}
+inline void glTexParameteri(GLenum, GLenum, GLint) {}
+inline GLint glGetUniformLocation(GLuint, const GLchar*) { return 0; }
+inline void glUniform1i(GLint, GLint) {}
+inline void glUniform4f(GLint, GLfloat, GLfloat, GLfloat, GLfloat) {}
+
+#endif
@@ -0,0 +1,30 @@
+// Minimal SFML stand-in for the loader tests. Images and textures are never decoded,
+// so the measurements only cover geometry.
+#ifndef SHIM_SFML_GRAPHICS_HPP
+#define SHIM_SFML_GRAPHICS_HPP
+
+#include <string>
+#include "Window.hpp"
+
+namespace sf {
+
+typedef unsigned char Uint8;
+
+class Image {
+public:
+	bool loadFromFile(const std::string&) { return true; }
+	void create(unsigned int, unsigned int) {}
+	Vector2u getSize() const { return Vector2u(); }
+	const Uint8* getPixelsPtr() const { return nullptr; }
+};
+
+class Texture {
+public:
+	bool loadFromFile(const std::string&) { return true; }
+	void setRepeated(bool) {}
+	static void bind(const Texture*) {}
+};
+
+}
+
+#endif
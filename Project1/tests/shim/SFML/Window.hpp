@@ -0,0 +1,17 @@
+// Minimal SFML stand-in for the loader tests.
+#ifndef SHIM_SFML_WINDOW_HPP
+#define SHIM_SFML_WINDOW_HPP
+
+namespace sf {
+
+template <typename T>
+struct Vector2 {
+	T x, y;
+	Vector2(T x = 0, T y = 0) : x(x), y(y) {}
+};
+
+typedef Vector2<unsigned int> Vector2u;
+
+}
+
+#endif
@@ -0,0 +1,33 @@
+// Minimal glm stand-in: only the vector types and helpers the loader uses.
+#ifndef SHIM_GLM_HPP
+#define SHIM_GLM_HPP
+
+#include <algorithm>
+
+namespace glm {
+
+struct vec2 {
+	float x, y;
+	vec2() : x(0), y(0) {}
+	vec2(float x, float y) : x(x), y(y) {}
+};
+
+struct vec3 {
+	float x, y, z;
+	vec3() : x(0), y(0), z(0) {}
+	explicit vec3(float s) : x(s), y(s), z(s) {}
+	vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+};
+
+struct vec4 {
+	float x, y, z, w;
+	vec4() : x(0), y(0), z(0), w(0) {}
+	vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+};
+
+inline vec3 min(const vec3& a, const vec3& b) { return vec3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)); }
+inline vec3 max(const vec3& a, const vec3& b) { return vec3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)); }
+
+}
+
+#endif
@@ -0,0 +1 @@
+#include "../glm.hpp"